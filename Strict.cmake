@@ -1,5 +1,5 @@
 # Build types for various sanitizer modes
-set(CMAKE_CONFIGURATION_TYPES "ASAN;MSAN;USAN" CACHE STRING "" FORCE)
+set(CMAKE_CONFIGURATION_TYPES "ASAN;MSAN;USAN;TSAN" CACHE STRING "" FORCE)
 
 # General compile and link options
 set(COMPILE_OPTS -g -O3 -Wall -Wextra -pedantic -pedantic-errors)
@@ -0,0 +1,224 @@
+#include "latency_histogram.h"
+#include "query_class.h"
+#include "searcher.h"
+#include "test_data.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations = 0;
+
+} // anonymous namespace
+
+// count heap allocations; GCC can't tell that these replacements pair
+// malloc with free and flags every inlined delete as mismatched
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new (const std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete (void * ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete (void * ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+const std::vector<std::filesystem::path> & docs()
+{
+    static const auto docs = [] {
+        auto docs = read_doc_list("test/etc/all_docs.txt", "test/etc");
+        for (auto & doc : docs) {
+            doc = doc.lexically_normal();
+        }
+        return docs;
+    }();
+    return docs;
+}
+
+Searcher & corpus()
+{
+    static Searcher s;
+    static const bool loaded = [] {
+        for (const auto & file : docs()) {
+            std::ifstream f(file);
+            s.add_document(file, f);
+        }
+        return true;
+    }();
+    static_cast<void>(loaded);
+    return s;
+}
+
+template <class Pred>
+std::vector<std::string> queries_of(Pred && pred)
+{
+    std::vector<std::string> selected;
+    for (auto & [query, _] : read_queries("test/etc/many_queries.txt")) {
+        if (pred(query)) {
+            selected.push_back(std::move(query));
+        }
+    }
+    return selected;
+}
+
+void report_latencies(benchmark::State & state, const LatencyHistogram & latencies)
+{
+    if (latencies.count() == 0) {
+        return;
+    }
+    const auto us = [] (const std::chrono::nanoseconds ns) {
+        return std::chrono::duration<double, std::micro>(ns).count();
+    };
+    state.counters["p50_us"] = us(latencies.percentile(0.5));
+    state.counters["p90_us"] = us(latencies.percentile(0.9));
+    state.counters["p99_us"] = us(latencies.percentile(0.99));
+    state.counters["p99.9_us"] = us(latencies.percentile(0.999));
+    state.counters["max_us"] = us(latencies.max());
+}
+
+void BM_Ingest(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        std::error_code ec;
+        bytes += std::filesystem::file_size(docs()[i], ec);
+    }
+    // only add_document is timed and counted, opening the files is not
+    LatencyHistogram latencies;
+    std::size_t add_allocations = 0;
+    for (auto _ : state) {
+        Searcher s;
+        std::chrono::duration<double> elapsed{};
+        for (std::size_t i = 0; i < n; ++i) {
+            std::ifstream f(docs()[i]);
+            const std::size_t allocations_before = allocations;
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            s.add_document(docs()[i], f);
+            const auto t2 = std::chrono::high_resolution_clock::now();
+            add_allocations += allocations - allocations_before;
+            elapsed += t2 - t1;
+            latencies.record(t2 - t1);
+        }
+        state.SetIterationTime(elapsed.count());
+        benchmark::DoNotOptimize(s);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["allocs"] = benchmark::Counter(add_allocations, benchmark::Counter::kAvgIterations);
+    report_latencies(state, latencies);
+}
+
+void search_queries(benchmark::State & state, const std::vector<std::string> & queries)
+{
+    Searcher & s = corpus();
+    if (queries.empty()) {
+        state.SkipWithError("No queries selected");
+        return;
+    }
+    LatencyHistogram latencies;
+    std::size_t i = 0;
+    const std::size_t allocations_before = allocations;
+    for (auto _ : state) {
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        const auto [begin, end] = s.search(queries[i]);
+        benchmark::DoNotOptimize(std::distance(begin, end));
+        const auto t2 = std::chrono::high_resolution_clock::now();
+        latencies.record(t2 - t1);
+        i = (i + 1) % queries.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs"] = benchmark::Counter(allocations - allocations_before, benchmark::Counter::kAvgIterations);
+    report_latencies(state, latencies);
+}
+
+void BM_Search(benchmark::State & state, const QueryClass query_class)
+{
+    search_queries(state, queries_of([query_class] (const std::string & query) {
+                return classify(query) == query_class;
+            }));
+}
+
+void BM_Search(benchmark::State & state, bool (* const selected)(const std::string &))
+{
+    search_queries(state, queries_of(selected));
+}
+
+void BM_Remove(benchmark::State & state)
+{
+    Searcher & s = corpus();
+    LatencyHistogram latencies;
+    std::size_t i = 0;
+    std::size_t remove_allocations = 0;
+    for (auto _ : state) {
+        const auto & file = docs()[i];
+        const std::size_t allocations_before = allocations;
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        s.remove_document(file);
+        const auto t2 = std::chrono::high_resolution_clock::now();
+        remove_allocations += allocations - allocations_before;
+        latencies.record(t2 - t1);
+
+        state.PauseTiming();
+        std::ifstream f(file);
+        s.add_document(file, f);
+        state.ResumeTiming();
+        i = (i + 1) % docs().size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs"] = benchmark::Counter(remove_allocations, benchmark::Counter::kAvgIterations);
+    report_latencies(state, latencies);
+}
+
+// batches growing fourfold, then the whole corpus, whatever its size
+void ingest_sizes(benchmark::internal::Benchmark * b)
+{
+    const auto total = static_cast<std::int64_t>(docs().size());
+    for (std::int64_t n = 256; n < total; n *= 4) {
+        b->Arg(n);
+    }
+    b->Arg(total);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_Ingest)->Apply(ingest_sizes)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Search, single_word, QueryClass::SingleWord)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Search, multi_word, QueryClass::MultiWord)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Search, phrase, QueryClass::Phrase)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Search, mixed, QueryClass::Mixed)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Search, stop_word_heavy, is_stop_word_heavy)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Remove)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#ifndef SEARCH_ENGINE_TESTS_LATENCY_HISTOGRAM_H
+#define SEARCH_ENGINE_TESTS_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// HDR-style histogram of nanosecond latencies: each power of two range
+// is split into SubBuckets linear buckets, so the relative error is bounded
+// by 1/SubBuckets; not synchronized, meant to be owned by a single thread
+class LatencyHistogram
+{
+    static constexpr std::size_t SubBits = 4;
+    static constexpr std::size_t SubBuckets = 1 << SubBits;
+
+    std::array<std::size_t, 64 * SubBuckets> m_counts{};
+    std::size_t m_total = 0;
+    std::uint64_t m_max = 0;
+
+    static std::size_t index(const std::uint64_t value)
+    {
+        if (value < SubBuckets) {
+            return value;
+        }
+        std::size_t exp = SubBits;
+        while ((value >> exp) > 1) {
+            ++exp;
+        }
+        const std::size_t shift = exp - SubBits;
+        return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+    }
+
+    static std::uint64_t upper_bound(const std::size_t i)
+    {
+        if (i < SubBuckets) {
+            return i;
+        }
+        const std::size_t shift = i / SubBuckets - 1;
+        return ((SubBuckets + i % SubBuckets + 1) << shift) - 1;
+    }
+public:
+    void record(const std::chrono::nanoseconds latency)
+    {
+        const auto value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(0, latency.count()));
+        ++m_counts[index(value)];
+        ++m_total;
+        m_max = std::max(m_max, value);
+    }
+
+    LatencyHistogram & operator += (const LatencyHistogram & other)
+    {
+        for (std::size_t i = 0; i < m_counts.size(); ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_total += other.m_total;
+        m_max = std::max(m_max, other.m_max);
+        return *this;
+    }
+
+    std::size_t count() const { return m_total; }
+
+    std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(m_max); }
+
+    std::chrono::nanoseconds percentile(const double p) const
+    {
+        const auto target = static_cast<std::size_t>(std::ceil(p * m_total));
+        std::size_t seen = 0;
+        for (std::size_t i = 0; i < m_counts.size(); ++i) {
+            seen += m_counts[i];
+            if (seen >= target && seen > 0) {
+                return std::chrono::nanoseconds(std::min(upper_bound(i), m_max));
+            }
+        }
+        return max();
+    }
+
+    std::ostream & print(std::ostream & strm) const
+    {
+        const auto us = [] (const std::chrono::nanoseconds ns) {
+            return std::chrono::duration<double, std::micro>(ns).count();
+        };
+        return strm << m_total << " samples"
+            << ", p50 " << us(percentile(0.5)) << "us"
+            << ", p90 " << us(percentile(0.9)) << "us"
+            << ", p99 " << us(percentile(0.99)) << "us"
+            << ", p99.9 " << us(percentile(0.999)) << "us"
+            << ", max " << us(max()) << "us";
+    }
+
+    friend std::ostream & operator << (std::ostream & strm, const LatencyHistogram & h)
+    {
+        return h.print(strm);
+    }
+};
+
+#endif // SEARCH_ENGINE_TESTS_LATENCY_HISTOGRAM_H
@@ -1,24 +1,54 @@
+#include "latency_histogram.h"
+#include "query_class.h"
 #include "searcher.h"
+#include "test_data.h"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <list>
 #include <map>
 #include <mutex>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <set>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <vector>
 
+#if __has_include(<malloc.h>)
+#include <malloc.h>
+#endif
+
 namespace {
 
 constexpr std::size_t ControlN = 2;
+// index may take at most this many bytes of heap per byte of source text
+constexpr std::size_t MemoryFactor = 2;
+constexpr std::chrono::milliseconds PhraseP99{10};
+// time to search and walk the results of all stop word heavy queries once
+constexpr std::chrono::seconds StopWordsLimit{10};
+// queries at least this long are considered heavy, a couple hundred of many_queries.txt
+constexpr std::size_t HeavyQueryLength = 100;
+constexpr std::chrono::milliseconds HeavyP99{20};
+constexpr std::chrono::seconds LoadLimit{60};
+constexpr std::chrono::milliseconds IngestP99{100};
+// time to fetch the first ControlN results of a very frequent word 1000 times
+constexpr std::chrono::milliseconds FirstResultsLimit{100};
+// time to remove a handful of the biggest books
+constexpr std::chrono::milliseconds RemoveLimit{50};
 
 template <class It>
 void advance_with_limit(std::size_t num, It & it, const It & end)
@@ -93,30 +123,53 @@ auto split_tasks(const std::size_t n, const std::vector<T> & items)
     return tasks;
 }
 
-auto read_queries(const std::string & filename)
+// bytes currently allocated from the heap, none if the allocator can't tell
+std::optional<std::size_t> heap_in_use()
 {
-    std::vector<std::pair<std::string, std::size_t>> queries;
-    std::ifstream f(filename);
-    for (std::string line; std::getline(f, line); ) {
-        const auto pos = line.find("\t");
-        if (pos != line.npos && (pos + 1) < line.size()) {
-            queries.emplace_back(line.substr(0, pos), std::stoul(line.substr(pos+1)));
-        }
-        else {
-            std::cerr << "Bad queries file content: " << line << "\n";
-        }
-    }
-    return queries;
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+    const auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#endif
+#endif
+    return std::nullopt;
 }
 
-auto read_doc_list(const std::string & filename, const std::filesystem::path & prefix)
+// query made of very frequent words only, with at least one quoted phrase of two or more words
+bool is_stop_word_phrase(const std::string & query)
 {
-    std::vector<std::filesystem::path> docs;
-    std::ifstream f(filename);
-    for (std::string line; std::getline(f, line); ) {
-        docs.emplace_back(prefix / line);
+    bool in_phrase = false, long_phrase = false;
+    std::size_t phrase_words = 0;
+    std::string word;
+    // false if the word just finished is not a stop word
+    const auto end_word = [&] () {
+        if (word.empty()) {
+            return true;
+        }
+        if (in_phrase) {
+            ++phrase_words;
+        }
+        const bool stop = is_stop_word(word);
+        word.clear();
+        return stop;
+    };
+    for (const char c : query) {
+        if (c != '"' && !std::isspace(static_cast<unsigned char>(c))) {
+            word += c;
+            continue;
+        }
+        if (!end_word()) {
+            return false;
+        }
+        if (c == '"') {
+            if (in_phrase && phrase_words > 1) {
+                long_phrase = true;
+            }
+            in_phrase = !in_phrase;
+            phrase_words = 0;
+        }
     }
-    return docs;
+    return end_word() && long_phrase;
 }
 
 class Document
@@ -209,14 +262,60 @@ struct InvertedIndexLoadTest : ::testing::Test
 {
     inline static Searcher s;
     inline static std::vector<std::pair<std::string, std::size_t>> queries;
+    inline static std::size_t corpus_size = 0;
+    inline static std::optional<std::size_t> index_memory;
+    inline static std::chrono::duration<double> load_time{};
+    inline static LatencyHistogram ingest_latencies;
 
     static void SetUpTestSuite()
     {
         queries = read_queries("test/etc/many_queries.txt");
-        for (const auto & file : read_doc_list("test/etc/all_docs.txt", "test/etc")) {
+        const auto docs = read_doc_list("test/etc/all_docs.txt", "test/etc");
+        const auto memory_before = heap_in_use();
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        for (const auto & file : docs) {
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(file, ec);
+            if (!ec) {
+                corpus_size += size;
+            }
             std::ifstream f(file);
+            const auto start = std::chrono::high_resolution_clock::now();
             s.add_document(file.lexically_normal(), f);
+            ingest_latencies.record(std::chrono::high_resolution_clock::now() - start);
+        }
+        load_time = std::chrono::high_resolution_clock::now() - t1;
+        const auto memory_after = heap_in_use();
+        if (memory_before && memory_after) {
+            index_memory = *memory_after > *memory_before ? *memory_after - *memory_before : 0;
+        }
+    }
+
+    // time searching and fetching the first ControlN results of every selected query
+    template <class Pred>
+    static LatencyHistogram time_queries(Pred && selected)
+    {
+        LatencyHistogram latencies;
+        for (const auto & [query, expected] : queries) {
+            if (!selected(query)) {
+                continue;
+            }
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            auto [begin, end] = s.search(query);
+            const bool found = begin != end;
+            advance_with_limit(ControlN, begin, end);
+            latencies.record(std::chrono::high_resolution_clock::now() - t1);
+            EXPECT_EQ(expected != 0, found) << query;
         }
+        return latencies;
+    }
+
+    static void check_p99(const std::string_view name, const LatencyHistogram & latencies, const std::chrono::nanoseconds limit)
+    {
+        ASSERT_LT(0, latencies.count()) << "No " << name << " queries";
+        std::cout << name << ": " << latencies << std::endl;
+        EXPECT_GT(limit, latencies.percentile(0.99))
+            << name << " p99 latency is " << std::chrono::duration<double, std::milli>(latencies.percentile(0.99)).count() << "ms";
     }
 };
 
@@ -664,6 +763,85 @@ TEST_F(InvertedIndexSmallTest, many)
     }
 }
 
+TEST_F(InvertedIndexSmallTest, load_order)
+{
+    const std::vector<const Document *> docs = {
+#define DOC(x) &x,
+#include "list.inl"
+#undef DOC
+    };
+    Searcher reversed;
+    for (auto it = docs.rbegin(); it != docs.rend(); ++it) {
+        reversed += **it;
+    }
+    for (const auto & [query, expected_number] : read_queries("test/etc/queries.txt")) {
+        const auto [begin, end] = s.search(query);
+        std::vector<Searcher::Filename> expected(begin, end);
+        std::sort(expected.begin(), expected.end());
+        const auto [r_begin, r_end] = reversed.search(query);
+        std::vector<Searcher::Filename> result(r_begin, r_end);
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(expected, result) << query;
+    }
+}
+
+TEST_F(InvertedIndexSmallTest, remove_big)
+{
+    remove(Moby_Dick, Ulysses, Middlemarch, David_Copperfield, Our_Mutual_Friend);
+    {
+        const auto [begin, end] = s.search("lantern");
+        EXPECT_EQ(20, std::distance(begin, end)) << "Found in " << sequence_printer(begin, end);
+        for (const auto & doc : {Moby_Dick, Ulysses, Middlemarch, David_Copperfield, Our_Mutual_Friend}) {
+            EXPECT_EQ(0, std::count(begin, end, doc)) << doc;
+        }
+    }
+    {
+        const auto [begin, end] = s.search("wight");
+        EXPECT_EQ(7, std::distance(begin, end)) << "Found in " << sequence_printer(begin, end);
+        EXPECT_EQ(0, std::count(begin, end, Moby_Dick));
+    }
+    load_docs(s, Moby_Dick);
+    {
+        const auto [begin, end] = s.search("wight");
+        EXPECT_EQ(8, std::distance(begin, end)) << "Found in " << sequence_printer(begin, end);
+        EXPECT_EQ(1, std::count(begin, end, Moby_Dick));
+    }
+    {
+        const auto [begin, end] = s.search("Ishmael");
+        EXPECT_EQ(1, std::count(begin, end, Moby_Dick));
+    }
+    load_docs(s, Ulysses, Middlemarch, David_Copperfield, Our_Mutual_Friend);
+    {
+        const auto [begin, end] = s.search("lantern");
+        EXPECT_EQ(25, std::distance(begin, end)) << "Found in " << sequence_printer(begin, end);
+        for (const auto & doc : {Moby_Dick, Ulysses, Middlemarch, David_Copperfield, Our_Mutual_Friend}) {
+            EXPECT_EQ(1, std::count(begin, end, doc)) << doc;
+        }
+    }
+}
+
+TEST_F(InvertedIndexSmallTest, search_order)
+{
+    const auto queries = read_queries("test/etc/queries.txt");
+    std::vector<std::vector<Searcher::Filename>> expected;
+    expected.reserve(queries.size());
+    for (const auto & [query, expected_number] : queries) {
+        const auto [begin, end] = s.search(query);
+        auto & result = expected.emplace_back(begin, end);
+        std::sort(result.begin(), result.end());
+    }
+    std::vector<std::size_t> indices(queries.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::mt19937_64 rnd(0); // always the same sequence
+    std::shuffle(indices.begin(), indices.end(), rnd);
+    for (const auto i : indices) {
+        const auto [begin, end] = s.search(queries[i].first);
+        std::vector<Searcher::Filename> result(begin, end);
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(expected[i], result) << queries[i].first;
+    }
+}
+
 TEST_F(InvertedIndexSmallTest, parallel_light)
 {
     using S = std::string_view;
@@ -881,6 +1059,82 @@ TEST_F(InvertedIndexSmallTest, parallel_many)
     EXPECT_LT(0, acc);
 }
 
+TEST_F(InvertedIndexSmallTest, parallel_add_remove)
+{
+    using S = std::string_view;
+    // queries whose results depend only on whether Frankenstein is indexed or not
+    const std::map<std::string_view, std::pair<std::size_t, std::size_t>> expected = {
+        {S{"Frankenstein"}, {1, 2}},
+        {S{"\"to order the horses\""}, {0, 1}},
+        {S{"\"my brother No one\""}, {0, 1}},
+        {S{"theirs"}, {42, 43}},
+        {S{"\"a subject for\""}, {6, 7}},
+    };
+    const std::size_t N = 4, K = 20;
+    std::atomic<bool> done = false;
+    std::atomic<std::size_t> ready = 0, passes = 0;
+    std::mutex mutex;
+    std::map<std::string_view, std::set<std::size_t>> results;
+    // size of a range obtained before the first remove and walked after the last add,
+    // and how many times Frankenstein occurs in it
+    std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>> held(N);
+    std::vector<std::thread> threads;
+    threads.reserve(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        threads.emplace_back([this, &mutex, &results, &done, &ready, &passes, &expected, &held = held[i], &searcher = s] () {
+                const auto [held_begin, held_end] = searcher.search("Frankenstein");
+                ++ready;
+                std::map<std::string_view, std::set<std::size_t>> result;
+                do {
+                    for (const auto & [query, _] : expected) {
+                        const auto [begin, end] = searcher.search(std::string{query});
+                        result[query].insert(std::distance(begin, end));
+                    }
+                    ++passes;
+                } while (!done);
+                held = {std::distance(held_begin, held_end), std::count(held_begin, held_end, Frankenstein)};
+                std::lock_guard g(mutex);
+                for (auto & [query, counts] : result) {
+                    results[query].merge(counts);
+                }
+            });
+    }
+    // every change to the index is overlapped by at least one full pass of some reader
+    const auto wait_passes = [&passes, N] (const std::size_t from) {
+        while (passes < from + N) {
+            std::this_thread::yield();
+        }
+    };
+    while (ready < N) {
+        std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < K; ++i) {
+        wait_passes(passes);
+        remove(Frankenstein);
+        wait_passes(passes);
+        load_docs(s, Frankenstein);
+    }
+    wait_passes(passes);
+    done = true;
+    for (auto & t : threads) {
+        t.join();
+    }
+    for (const auto & [size, count] : held) {
+        EXPECT_EQ(2, size);
+        EXPECT_EQ(1, count);
+    }
+    for (const auto & [query, bounds] : expected) {
+        const auto & counts = results[query];
+        ASSERT_FALSE(counts.empty()) << query;
+        EXPECT_LE(bounds.first, *counts.begin()) << query;
+        EXPECT_GE(bounds.second, *counts.rbegin()) << query;
+    }
+    for (const auto & [query, bounds] : expected) {
+        const auto [begin, end] = s.search(std::string{query});
+        EXPECT_EQ(bounds.second, std::distance(begin, end)) << query;
+    }
+}
+
 TEST_F(InvertedIndexLoadTest, many)
 {
     const std::size_t N = 4;
@@ -952,15 +1206,24 @@ TEST_F(InvertedIndexLoadTest, timing)
         }
         std::shuffle(indices.begin(), indices.end(), rnd);
     }
+    std::vector<QueryClass> classes;
+    classes.reserve(queries.size());
+    for (const auto & [query, expected] : queries) {
+        classes.push_back(classify(query));
+    }
+    using Histograms = std::array<LatencyHistogram, QueryClasses>;
+    std::vector<Histograms> histograms(N);
     std::vector<std::thread> threads;
     threads.reserve(N);
     int acc = 0;
     const auto t1 = std::chrono::high_resolution_clock::now();
-    for (const auto & task : tasks) {
-        threads.emplace_back([&acc, &task, &searcher = s] () {
+    for (std::size_t n = 0; n < N; ++n) {
+        threads.emplace_back([&acc, &task = tasks[n], &histogram = histograms[n], &classes, &searcher = s] () {
                 for (const auto i : task) {
+                    const auto start = std::chrono::high_resolution_clock::now();
                     auto [begin, end] = searcher.search(queries[i].first);
                     advance_with_limit(ControlN, begin, end);
+                    histogram[static_cast<std::size_t>(classes[i])].record(std::chrono::high_resolution_clock::now() - start);
                     if (begin != end) {
                         ++acc;
                     }
@@ -972,6 +1235,137 @@ TEST_F(InvertedIndexLoadTest, timing)
     }
     const auto t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> diff = t2 - t1;
+    LatencyHistogram total;
+    for (std::size_t c = 0; c < QueryClasses; ++c) {
+        LatencyHistogram merged;
+        for (const auto & h : histograms) {
+            merged += h[c];
+        }
+        total += merged;
+        std::cout << query_class_names[c] << ": " << merged << "\n";
+    }
+    std::cout << "all: " << total << std::endl;
     EXPECT_LT(0, acc);
     EXPECT_GT(40, diff.count()) << "Search took too long";
 }
+
+TEST_F(InvertedIndexLoadTest, stop_words)
+{
+    std::vector<std::size_t> selected;
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        if (is_stop_word_heavy(queries[i].first)) {
+            selected.push_back(i);
+        }
+    }
+    ASSERT_FALSE(selected.empty());
+    std::size_t acc = 0;
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    for (const auto i : selected) {
+        const auto [begin, end] = s.search(queries[i].first);
+        for (auto it = begin; it != end; ++it) {
+            acc += it->size();
+        }
+    }
+    const auto t2 = std::chrono::high_resolution_clock::now();
+    EXPECT_LT(0, acc);
+    EXPECT_GT(StopWordsLimit, t2 - t1) << "Search of " << selected.size() << " stop word queries took "
+        << std::chrono::duration<double>(t2 - t1).count() << "s";
+}
+
+TEST_F(InvertedIndexLoadTest, phrases)
+{
+    check_p99("phrases", time_queries([] (const std::string & query) {
+                return query.find('"') != query.npos;
+            }), PhraseP99);
+}
+
+TEST_F(InvertedIndexLoadTest, stop_word_phrases)
+{
+    check_p99("stop word phrases", time_queries(is_stop_word_phrase), PhraseP99);
+}
+
+TEST_F(InvertedIndexLoadTest, heavy_queries)
+{
+    check_p99("heavy", time_queries([] (const std::string & query) {
+                return query.size() >= HeavyQueryLength;
+            }), HeavyP99);
+}
+
+TEST_F(InvertedIndexLoadTest, first_results)
+{
+    const std::size_t K = 1000;
+    const std::vector<std::string> frequent = {"the", "a", "and", "to"};
+    std::size_t acc = 0;
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < K; ++i) {
+        auto [begin, end] = s.search(frequent[i % frequent.size()]);
+        advance_with_limit(ControlN, begin, end);
+        if (begin != end) {
+            ++acc;
+        }
+    }
+    const auto t2 = std::chrono::high_resolution_clock::now();
+    EXPECT_EQ(K, acc);
+    EXPECT_GT(FirstResultsLimit, t2 - t1) << "Fetching first results took " << std::chrono::duration<double, std::milli>(t2 - t1).count() << "ms";
+}
+
+TEST_F(InvertedIndexLoadTest, loading)
+{
+    const double seconds = load_time.count();
+    std::cout << "loading: " << ingest_latencies.count() << " documents, " << corpus_size / 1e6 << "MB in " << seconds << "s";
+    if (seconds > 0) {
+        std::cout << ", " << corpus_size / 1e6 / seconds << "MB/s, " << ingest_latencies.count() / seconds << " documents/s";
+    }
+    std::cout << std::endl;
+    EXPECT_GT(LoadLimit, load_time) << "Loading of documents took " << load_time.count() << "s";
+}
+
+TEST_F(InvertedIndexLoadTest, ingest_latency)
+{
+    std::cout << "add_document: " << ingest_latencies << std::endl;
+    EXPECT_GT(IngestP99, ingest_latencies.percentile(0.99))
+        << "add_document p99 latency is " << std::chrono::duration<double, std::milli>(ingest_latencies.percentile(0.99)).count() << "ms";
+}
+
+TEST_F(InvertedIndexLoadTest, memory)
+{
+    if (!index_memory) {
+        GTEST_SKIP() << "Heap usage is only known with glibc 2.33 or newer";
+    }
+    EXPECT_LT(0, corpus_size);
+    ASSERT_LT(0, *index_memory) << "No heap growth recorded while loading documents";
+    EXPECT_GT(MemoryFactor * corpus_size, *index_memory)
+        << "Index takes " << *index_memory << " bytes for " << corpus_size << " bytes of documents";
+}
+
+TEST_F(InvertedIndexLoadTest, remove_big)
+{
+    const std::vector<Searcher::Filename> big = {
+        "test/etc/Moby_Dick.txt",
+        "test/etc/Ulysses.txt",
+        "test/etc/Middlemarch.txt",
+        "test/etc/David_Copperfield.txt",
+        "test/etc/Our_Mutual_Friend.txt",
+    };
+    const auto count_found = [&big] (const std::string & query) {
+        const auto [begin, end] = s.search(query);
+        std::size_t found = 0;
+        for (const auto & file : big) {
+            found += std::count(begin, end, file);
+        }
+        return found;
+    };
+    ASSERT_EQ(big.size(), count_found("lantern"));
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    for (const auto & file : big) {
+        s.remove_document(file);
+    }
+    const auto t2 = std::chrono::high_resolution_clock::now();
+    EXPECT_EQ(0, count_found("lantern"));
+    for (const auto & file : big) {
+        std::ifstream f(file);
+        s.add_document(file, f);
+    }
+    EXPECT_EQ(big.size(), count_found("lantern"));
+    EXPECT_GT(RemoveLimit, t2 - t1) << "Removal took " << std::chrono::duration<double, std::milli>(t2 - t1).count() << "ms";
+}
@@ -0,0 +1,78 @@
+#ifndef SEARCH_ENGINE_TESTS_QUERY_CLASS_H
+#define SEARCH_ENGINE_TESTS_QUERY_CLASS_H
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// shape of a query, used to break latency reports down
+enum class QueryClass : std::size_t
+{
+    SingleWord,
+    MultiWord,
+    Phrase,
+    Mixed
+};
+
+constexpr std::size_t QueryClasses = 4;
+
+constexpr std::array<std::string_view, QueryClasses> query_class_names = {"single word", "multi-word", "phrase", "mixed"};
+
+inline QueryClass classify(const std::string_view query)
+{
+    std::size_t words = 0, phrases = 0;
+    bool in_phrase = false, in_word = false;
+    for (const char c : query) {
+        if (c == '"') {
+            phrases += in_phrase ? 1 : 0;
+            in_phrase = !in_phrase;
+            in_word = false;
+        }
+        else if (std::isspace(static_cast<unsigned char>(c))) {
+            in_word = false;
+        }
+        else if (!in_phrase && !in_word) {
+            in_word = true;
+            ++words;
+        }
+    }
+    if (phrases == 0) {
+        return words > 1 ? QueryClass::MultiWord : QueryClass::SingleWord;
+    }
+    return words == 0 ? QueryClass::Phrase : QueryClass::Mixed;
+}
+
+inline bool is_stop_word(std::string word)
+{
+    static const std::set<std::string> stop_words = {
+        "a", "an", "and", "as", "at", "be", "but", "by", "for", "had", "have", "he", "her", "him", "his",
+        "i", "in", "is", "it", "me", "my", "not", "of", "on", "she", "that", "the", "this", "to", "was",
+        "what", "when", "where", "which", "whom", "with", "you"
+    };
+    std::transform(word.begin(), word.end(), word.begin(), [] (const unsigned char c) { return std::tolower(c); });
+    return stop_words.find(word) != stop_words.end();
+}
+
+// unquoted multi-word query where at least a half of the words are very frequent ones
+inline bool is_stop_word_heavy(const std::string & query)
+{
+    if (query.find('"') != query.npos) {
+        return false;
+    }
+    std::size_t words = 0, frequent = 0;
+    std::istringstream strm(query);
+    for (std::string word; strm >> word; ) {
+        ++words;
+        if (is_stop_word(word)) {
+            ++frequent;
+        }
+    }
+    return words > 1 && frequent * 2 >= words;
+}
+
+#endif
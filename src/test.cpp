@@ -6,6 +6,7 @@
 #include <iterator>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace {
 
@@ -360,6 +361,56 @@ TEST(SearchEngineBasicTests, PunctInTheMiddle)
     }
 }
 
+TEST(SearchEngineBasicTests, PunctAtEveryOffset)
+{
+    Searcher::Filename punct_file("punct.txt");
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+
+    // the k-th Mark token starts at offset k % 64 of a 64 byte block and
+    // the k-th Middle token at (k + 32) % 64, so both go through every offset
+    const std::size_t N = 128, Block = 64;
+    std::string text;
+    const auto pad_to = [&text] (const char c, const std::size_t offset) {
+        text += c;
+        while (text.size() % Block != offset) {
+            text += c;
+        }
+    };
+    for (std::size_t k = 0; k < N; ++k) {
+        pad_to(' ', k % Block);
+        text += "...(\"Mark" + std::to_string(k) + "\"),";
+        pad_to('\n', (k + Block / 2) % Block);
+        text += "-In-The--Middle" + std::to_string(k) + "-";
+    }
+    auto punct_stream = create_ss(text);
+
+    Searcher s;
+    s.add_document(punct_file, punct_stream);
+    s.add_document(simple_file, simple_stream);
+
+    for (std::size_t k = 0; k < N; ++k) {
+        const auto [begin, end] = s.search("mark" + std::to_string(k));
+        ASSERT_NE(begin, end) << k;
+        EXPECT_EQ(punct_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    for (std::size_t k = 0; k + 1 < N; ++k) {
+        const auto [begin, end] = s.search("\"in-the--middle" + std::to_string(k) + " MARK" + std::to_string(k + 1) + "\"");
+        ASSERT_NE(begin, end) << k;
+        EXPECT_EQ(punct_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("In");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("Middle5");
+        EXPECT_EQ(begin, end);
+    }
+}
+
 TEST(SearchEngineBasicTests, TextWithoutSpaceSymbols)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -425,6 +476,81 @@ TEST(SearchEngineBasicTests, ThreePairsOfIterators)
     ASSERT_EQ(begin_third, end_third);
 }
 
+TEST(SearchEngineBasicTests, PartiallyConsumedResults)
+{
+    Searcher::Filename first_file("first.txt");
+    auto first_stream = create_ss("the first");
+    Searcher::Filename second_file("second.txt");
+    auto second_stream = create_ss("the second");
+    Searcher::Filename third_file("third.txt");
+    auto third_stream = create_ss("the third");
+
+    Searcher s;
+    s.add_document(first_file, first_stream);
+    s.add_document(second_file, second_stream);
+    s.add_document(third_file, third_stream);
+
+    auto [begin_first, end_first] = s.search("the");
+    auto [begin_second, end_second] = s.search("the");
+
+    ASSERT_NE(begin_first, end_first);
+    begin_first++;
+    ASSERT_NE(begin_second, end_second);
+    begin_second++;
+    ASSERT_NE(begin_second, end_second);
+    begin_second++;
+
+    const auto rest_first = begin_first;
+    EXPECT_EQ(2, std::distance(begin_first, end_first));
+    EXPECT_EQ(1, std::distance(begin_second, end_second));
+
+    begin_first++;
+    EXPECT_EQ(1, std::distance(begin_first, end_first));
+    EXPECT_EQ(2, std::distance(rest_first, end_first));
+
+    const auto [begin_all, end_all] = s.search("the");
+    EXPECT_EQ(3, std::distance(begin_all, end_all));
+    EXPECT_EQ(1, std::count(begin_all, end_all, first_file));
+    EXPECT_EQ(1, std::count(begin_all, end_all, second_file));
+    EXPECT_EQ(1, std::count(begin_all, end_all, third_file));
+    EXPECT_EQ(1, std::count(begin_all, end_all, *begin_second));
+    EXPECT_EQ(1, std::count(begin_all, end_all, *rest_first));
+}
+
+TEST(SearchEngineBasicTests, RepeatedWordInDocument)
+{
+    Searcher::Filename repeats_file("repeats.txt");
+    auto repeats_stream = create_ss("the the, The. the; THE the! the end");
+    Searcher::Filename once_file("once.txt");
+    auto once_stream = create_ss("the beginning");
+
+    Searcher s;
+    s.add_document(repeats_file, repeats_stream);
+    s.add_document(once_file, once_stream);
+
+    {
+        const auto [begin, end] = s.search("the");
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, repeats_file));
+        EXPECT_EQ(1, std::count(begin, end, once_file));
+    }
+    {
+        const auto [begin, end] = s.search("\"the the\" the");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(repeats_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+
+    s.remove_document(once_file);
+
+    {
+        const auto [begin, end] = s.search("the");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(repeats_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
 TEST(SearchEngineBasicTests, WordInTheTwoDocuments)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -517,6 +643,237 @@ TEST(SearchEngineBasicTests, AddSameDocumentTwice)
     }
 }
 
+TEST(SearchEngineBasicTests, DocumentOutlivesStream)
+{
+    Searcher::Filename simple_file("simple.txt");
+
+    Searcher s;
+    {
+        auto simple_stream = create_ss("One, two, three.");
+        s.add_document(simple_file, simple_stream);
+    }
+
+    {
+        const auto [begin, end] = s.search("\"two three\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(simple_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
+TEST(SearchEngineBasicTests, IndependentSearchers)
+{
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+    Searcher::Filename singleton_file("singleton.txt");
+    auto singleton_stream = create_ss("two");
+
+    Searcher first;
+    Searcher second;
+    first.add_document(simple_file, simple_stream);
+    second.add_document(singleton_file, singleton_stream);
+
+    {
+        const auto [begin, end] = first.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(simple_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = second.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(singleton_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+
+    first.remove_document(simple_file);
+
+    {
+        const auto [begin, end] = first.search("two");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = second.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(singleton_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
+TEST(SearchEngineBasicTests, RepeatedQueryAfterUpdate)
+{
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+    auto simple_stream2 = create_ss("Five");
+    Searcher::Filename other_file("other.txt");
+    auto other_stream = create_ss("two four");
+
+    Searcher s;
+    s.add_document(simple_file, simple_stream);
+
+    for (int i = 0; i < 2; ++i) {
+        const auto [begin, end] = s.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(simple_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+
+    s.add_document(other_file, other_stream);
+
+    {
+        const auto [begin, end] = s.search("two");
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, simple_file));
+        EXPECT_EQ(1, std::count(begin, end, other_file));
+    }
+    {
+        const auto [begin, end] = s.search("TWO");
+        EXPECT_EQ(2, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"two three\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(simple_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+
+    s.remove_document(simple_file);
+
+    {
+        const auto [begin, end] = s.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(other_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"two three\"");
+        EXPECT_EQ(begin, end);
+    }
+
+    s.add_document(simple_file, simple_stream2);
+
+    {
+        const auto [begin, end] = s.search("two");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(other_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("five");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(simple_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
+TEST(SearchEngineBasicTests, WordsAcrossBufferBoundaries)
+{
+    Searcher::Filename big_file("big.txt");
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+
+    // put a distinct word over every power of two offset up to 1M
+    std::string text;
+    std::vector<std::string> markers;
+    for (std::size_t boundary = 1024; boundary <= 1024 * 1024; boundary *= 2) {
+        const auto & marker = markers.emplace_back("marker" + std::to_string(boundary));
+        const std::size_t start = boundary - marker.size() / 2;
+        while (text.size() + 7 < start) {
+            text += "filler ";
+        }
+        text.append(start - text.size(), ' ');
+        text += marker + " ";
+    }
+    const std::string long_word = std::string(100000, 'x') + "y";
+    text += long_word + ", the end.";
+    auto big_stream = create_ss(text);
+
+    Searcher s;
+    s.add_document(big_file, big_stream);
+    s.add_document(simple_file, simple_stream);
+
+    for (const auto & marker : markers) {
+        const auto [begin, end] = s.search(marker);
+        ASSERT_NE(begin, end) << marker;
+        EXPECT_EQ(big_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"filler " + markers.back() + "\" " + long_word);
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(big_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"the end\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(big_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("marker");
+        EXPECT_EQ(begin, end);
+    }
+}
+
+TEST(SearchEngineBasicTests, WordsSharingPrefix)
+{
+    Searcher::Filename first_file("first.txt");
+    auto first_stream = create_ss("engine engineer, engineering");
+    Searcher::Filename second_file("second.txt");
+    auto second_stream = create_ss("engines; engine");
+
+    Searcher s;
+    s.add_document(first_file, first_stream);
+
+    {
+        const auto [begin, end] = s.search("engineer");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(first_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("engin");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("engines");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("engineeringx");
+        EXPECT_EQ(begin, end);
+    }
+
+    s.add_document(second_file, second_stream);
+
+    {
+        const auto [begin, end] = s.search("engines");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(second_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("engine");
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, first_file));
+        EXPECT_EQ(1, std::count(begin, end, second_file));
+    }
+
+    s.remove_document(first_file);
+
+    {
+        const auto [begin, end] = s.search("engineer");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("engine engines");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(second_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
 TEST(SearchQueryTests, SingleWordInAPhrase)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -613,6 +970,71 @@ TEST(SearchQueryTests, TwoWordsWithQuotesInTheQuery)
     }
 }
 
+TEST(SearchQueryTests, WordPairsInPhrases)
+{
+    Searcher::Filename first_file("first.txt");
+    auto first_stream = create_ss("ride the - horses, then the carriage");
+    Searcher::Filename second_file("second.txt");
+    auto second_stream = create_ss("horses were tired; the");
+    Searcher::Filename third_file("third.txt");
+    auto third_stream = create_ss("then the horses ran");
+
+    Searcher s;
+    s.add_document(first_file, first_stream);
+    s.add_document(second_file, second_stream);
+
+    {
+        const auto [begin, end] = s.search("\"the horses\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(first_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"the horses then\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(first_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        // both word pairs are present, but not one after another
+        const auto [begin, end] = s.search("\"then the horses\"");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        // a pair must not span two documents
+        const auto [begin, end] = s.search("\"carriage horses\"");
+        EXPECT_EQ(begin, end);
+    }
+
+    s.add_document(third_file, third_stream);
+
+    {
+        const auto [begin, end] = s.search("\"then the horses\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(third_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"the horses\"");
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, first_file));
+        EXPECT_EQ(1, std::count(begin, end, third_file));
+    }
+
+    s.remove_document(first_file);
+
+    {
+        const auto [begin, end] = s.search("\"the horses\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(third_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"the carriage\"");
+        EXPECT_EQ(begin, end);
+    }
+}
+
 TEST(SearchQueryTests, PhraseAndIndividualWords)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -647,6 +1069,52 @@ TEST(SearchQueryTests, PhraseAndIndividualWords)
     }
 }
 
+TEST(SearchQueryTests, PhraseWithRepeatedWords)
+{
+    Searcher::Filename repeats_file("repeats.txt");
+    auto repeats_stream = create_ss("one one one two, one three one one");
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+
+    Searcher s;
+    s.add_document(repeats_file, repeats_stream);
+    s.add_document(simple_file, simple_stream);
+
+    {
+        const auto [begin, end] = s.search("\"one one two\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(repeats_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"one one one two one three one one\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(repeats_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"one two\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, repeats_file));
+        EXPECT_EQ(1, std::count(begin, end, simple_file));
+    }
+    {
+        const auto [begin, end] = s.search("\"one one one one\"");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("\"two one one\"");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("\"three one one\" \"one one one\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(repeats_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+}
+
 TEST(SearchQueryTests, ComplexQuery)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -714,6 +1182,42 @@ TEST(SearchQueryTests, ComplexQuery)
     }
 }
 
+TEST(SearchQueryTests, TermOrderAndDuplicates)
+{
+    Searcher::Filename simple_file("test/etc/simple_file.txt");
+    std::ifstream simple_file_stream(simple_file);
+    Searcher::Filename simple_file_copy("test/etc/simple_file_copy.txt");
+    std::ifstream simple_file_copy_stream(simple_file_copy);
+    Searcher::Filename call_me_ishmael("test/etc/call_me_ishmael.txt");
+    std::ifstream call_me_ishmael_stream(call_me_ishmael);
+
+    Searcher s;
+    s.add_document(simple_file, simple_file_stream);
+    s.add_document(simple_file_copy, simple_file_copy_stream);
+    s.add_document(call_me_ishmael, call_me_ishmael_stream);
+
+    for (const auto & query : {
+              "\"the query\" \"A goal\" the optimize"
+            , "optimize the \"A goal\" \"the query\""
+            , "the \"A goal\" \"A goal\" optimize \"the query\" \"the query\" the"
+            , "\"A goal\" optimize optimize OPTIMIZE \"the query\""}) {
+        const auto [begin, end] = s.search(query);
+        EXPECT_EQ(2, std::distance(begin, end)) << query;
+        EXPECT_EQ(1, std::count(begin, end, simple_file)) << query;
+        EXPECT_EQ(1, std::count(begin, end, simple_file_copy)) << query;
+    }
+
+    for (const auto & query : {
+              "Boris \"the query\" the the optimize"
+            , "\"the query\" the Boris the optimize"
+            , "\"the query\" the the optimize Boris"
+            , "\"the query\" \"A Boris\" the optimize"
+            , "the the the \"Boris the\""}) {
+        const auto [begin, end] = s.search(query);
+        EXPECT_EQ(begin, end) << query;
+    }
+}
+
 TEST(SearchQueryTests, IncorrectQuery)
 {
     Searcher::Filename simple_file("test/etc/simple_file.txt");
@@ -731,6 +1235,48 @@ TEST(SearchQueryTests, IncorrectQuery)
     ASSERT_THROW(s.search("\"...\""), Searcher::BadQuery);
     ASSERT_THROW(s.search("\"\":  "), Searcher::BadQuery);
     ASSERT_THROW(s.search("(_*_)"), Searcher::BadQuery);
+    ASSERT_THROW(s.search("\t"), Searcher::BadQuery);
+    ASSERT_THROW(s.search("\"the\" \"query"), Searcher::BadQuery);
+    ASSERT_THROW(s.search("the \"query\" \""), Searcher::BadQuery);
+}
+
+TEST(SearchQueryTests, ManyTokensQuery)
+{
+    Searcher::Filename words_file("words.txt");
+    Searcher::Filename simple_file("simple.txt");
+    auto simple_stream = create_ss("One, two, three.");
+
+    std::string text, query;
+    for (std::size_t i = 0; i < 200; ++i) {
+        text += "w" + std::to_string(i) + (i % 7 == 0 ? ", " : " ");
+        query += " w" + std::to_string(i);
+    }
+    auto words_stream = create_ss(text);
+
+    Searcher s;
+    s.add_document(words_file, words_stream);
+    s.add_document(simple_file, simple_stream);
+
+    {
+        const auto [begin, end] = s.search(query);
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(words_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("\"" + query + "\"");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(words_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search(query + " w200");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("\"" + query + " w0\"");
+        EXPECT_EQ(begin, end);
+    }
 }
 
 
@@ -847,6 +1393,67 @@ TEST(SearchEngineRemoveDocumentTests, IncorrectRemoveCall)
     }
 }
 
+TEST(SearchEngineRemoveDocumentTests, FilenamesSharingPrefix)
+{
+    Searcher::Filename doc_file("doc.txt");
+    auto doc_stream = create_ss("alpha common");
+    Searcher::Filename backup_file("doc.txt.bak");
+    auto backup_stream = create_ss("beta common");
+    Searcher::Filename short_file("d");
+    auto short_stream = create_ss("gamma common");
+    Searcher::Filename new_file("new.txt");
+    auto new_stream = create_ss("delta common");
+
+    Searcher s;
+    s.add_document(doc_file, doc_stream);
+    s.add_document(backup_file, backup_stream);
+    s.add_document(short_file, short_stream);
+
+    {
+        const auto [begin, end] = s.search("common");
+        EXPECT_EQ(3, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, doc_file));
+        EXPECT_EQ(1, std::count(begin, end, backup_file));
+        EXPECT_EQ(1, std::count(begin, end, short_file));
+    }
+
+    s.remove_document(doc_file);
+    s.add_document(new_file, new_stream);
+
+    {
+        const auto [begin, end] = s.search("alpha");
+        EXPECT_EQ(begin, end);
+    }
+    {
+        const auto [begin, end] = s.search("beta");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(backup_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("delta common");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(new_file, *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+    {
+        const auto [begin, end] = s.search("common");
+        EXPECT_EQ(3, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, backup_file));
+        EXPECT_EQ(1, std::count(begin, end, short_file));
+        EXPECT_EQ(1, std::count(begin, end, new_file));
+    }
+
+    s.remove_document(short_file);
+
+    {
+        const auto [begin, end] = s.search("common");
+        EXPECT_EQ(2, std::distance(begin, end));
+        EXPECT_EQ(1, std::count(begin, end, backup_file));
+        EXPECT_EQ(1, std::count(begin, end, new_file));
+    }
+}
+
 TEST(SearchEngineRemoveDocumentTests, RemoveEmptyDocument)
 {
     Searcher::Filename empty_file("test/etc/empty_file.txt");
@@ -961,3 +1568,79 @@ TEST(SearchEngineBigDocs, add_and_remove)
     NOT_FOUND("\"my brother No one\"");
     CHECK("\"Volunteers and financial support to provide volunteers with the assistance they need, are critical to reaching Project Gutenberg-tm's\"", Pride_and_Prejudice);
 }
+
+TEST(SearchEngineBigDocs, rare_and_frequent)
+{
+    Searcher::Filename Frankenstein("test/etc/Frankenstein.txt");
+    std::ifstream Frankenstein_stream(Frankenstein);
+    Searcher::Filename Pride_and_Prejudice("test/etc/Pride_and_Prejudice.txt");
+    std::ifstream Pride_and_Prejudice_stream(Pride_and_Prejudice);
+    Searcher::Filename Moby_Dick("test/etc/Moby_Dick.txt");
+    std::ifstream Moby_Dick_stream(Moby_Dick);
+
+    Searcher s;
+    s.add_document(Frankenstein, Frankenstein_stream);
+    s.add_document(Pride_and_Prejudice, Pride_and_Prejudice_stream);
+    s.add_document(Moby_Dick, Moby_Dick_stream);
+
+    CHECK("Frankenstein a to the and an of the I in that", Frankenstein);
+    CHECK("a to the and an of the I in that Frankenstein", Frankenstein);
+    CHECK("the of a and Prejudice to", Frankenstein, Pride_and_Prejudice);
+    NOT_FOUND("a to the and an of the I in that when was his whom you this where ksfhiwefhliwehapoheioi");
+}
+
+TEST(SearchEngineBigDocs, dense_and_sparse)
+{
+    const std::size_t N = 10000;
+    const auto filename = [] (const std::size_t i) -> Searcher::Filename {
+        return "doc" + std::to_string(i) + ".txt";
+    };
+    const auto count = [] (const auto & range) {
+        return static_cast<std::size_t>(std::distance(range.first, range.second));
+    };
+
+    Searcher s;
+    for (std::size_t i = 0; i < N; ++i) {
+        std::string text = "word" + std::to_string(i);
+        if (i % 100 != 0) {
+            text += " common";
+        }
+        if (i % 2 == 0) {
+            text += " even";
+        }
+        if (i % 1000 == 7) {
+            text += " rare";
+        }
+        auto stream = create_ss(text);
+        s.add_document(filename(i), stream);
+    }
+
+    EXPECT_EQ(9900, count(s.search("common")));
+    EXPECT_EQ(5000, count(s.search("even")));
+    EXPECT_EQ(4900, count(s.search("common even")));
+    EXPECT_EQ(10, count(s.search("rare common")));
+    EXPECT_EQ(0, count(s.search("even rare")));
+    {
+        const auto [begin, end] = s.search("rare word1007 common");
+        ASSERT_NE(begin, end);
+        EXPECT_EQ(filename(1007), *begin);
+        EXPECT_EQ(1, std::distance(begin, end));
+    }
+
+    for (std::size_t i = 0; i < N; i += 4) {
+        s.remove_document(filename(i));
+    }
+
+    EXPECT_EQ(2500, count(s.search("even")));
+    EXPECT_EQ(2500, count(s.search("even common")));
+    EXPECT_EQ(10, count(s.search("common rare")));
+
+    for (std::size_t i = 100; i < N; ++i) {
+        s.remove_document(filename(i));
+    }
+
+    EXPECT_EQ(75, count(s.search("common")));
+    EXPECT_EQ(25, count(s.search("even common")));
+    EXPECT_EQ(1, count(s.search("rare")));
+    EXPECT_EQ(1, count(s.search("word7 common")));
+}
@@ -0,0 +1,40 @@
+#ifndef SEARCH_ENGINE_TESTS_TEST_DATA_H
+#define SEARCH_ENGINE_TESTS_TEST_DATA_H
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// query and expected number of results per line, tab separated
+inline auto read_queries(const std::string & filename)
+{
+    std::vector<std::pair<std::string, std::size_t>> queries;
+    std::ifstream f(filename);
+    for (std::string line; std::getline(f, line); ) {
+        const auto pos = line.find("\t");
+        if (pos != line.npos && (pos + 1) < line.size()) {
+            queries.emplace_back(line.substr(0, pos), std::stoul(line.substr(pos+1)));
+        }
+        else {
+            std::cerr << "Bad queries file content: " << line << "\n";
+        }
+    }
+    return queries;
+}
+
+// one document path per line, relative to prefix
+inline auto read_doc_list(const std::string & filename, const std::filesystem::path & prefix)
+{
+    std::vector<std::filesystem::path> docs;
+    std::ifstream f(filename);
+    for (std::string line; std::getline(f, line); ) {
+        docs.emplace_back(prefix / line);
+    }
+    return docs;
+}
+
+#endif // SEARCH_ENGINE_TESTS_TEST_DATA_H